@@ -5,33 +5,35 @@
  */
 #include "project.h"
 
+// Replay harness (replay.cpp) provides its own entry point
+#ifndef BMS_NO_MAIN
 int main(int argc, char *argv[])
 {
-    // Input files 
-    std::string BTSFile = "bts.csv";
-    std::string inputFile = processParameters(argc, argv);
-    if (inputFile.compare(EMPTY_STRING) == 0)
+    // Resolve runtime parameters once, they stay frozen from here on
+    T_Config parsedConfig;
+    if (!processParameters(argc, argv, parsedConfig))
     {
-        std::cerr << "Please specify input file as the first parameter.\n";
+        std::cerr << "Usage: p1 <input.csv> [-c config] [-b bts.csv] [-o output] [-f frequency] [-u ueHeight] [-a correctionFactor] [-m mapsUrl]\n";
         return EXIT_FAILURE_PARAMS;
     }
+    const T_Config config = parsedConfig;
 
     // Load information about stations
-    std::vector<T_NearestStation> nearestStations = loadNearestStations(inputFile);
+    std::vector<T_NearestStation> nearestStations = loadNearestStations(config.inputFile);
     if (nearestStations.empty())
     {
         std::cerr << "Input file could not be opened, or error occured while reading it. Fix the file and try again, please.\n";
         return EXIT_FAILURE_INPUTFILE;
     }
 
-    std::vector<T_Station> allStations = loadBTSRecords(BTSFile);
+    std::vector<T_Station> allStations = loadBTSRecords(config.BTSFile);
     if (allStations.empty())
     {
-        std::cerr << "Input file BTS.csv could not be opened, or error occured while reading it. Fix the file and try again, please.\n";
+        std::cerr << "Input file " << config.BTSFile << " could not be opened, or error occured while reading it. Fix the file and try again, please.\n";
         return EXIT_FAILURE_INPUTFILE;
     }
 
-    std::vector<T_MatchedStation> matchingStations = prepareMatchingStation(nearestStations, allStations);
+    std::vector<T_MatchedStation> matchingStations = prepareMatchingStation(nearestStations, allStations, config);
     
     T_GPS UELocation = calculateUELocation(matchingStations);
     if (UELocation.latitude <= -1 && UELocation.longitude <= -1)
@@ -39,11 +41,18 @@ int main(int argc, char *argv[])
         std::cerr << "You need at least 3 stations to determine location precisely.\n";
         return EXIT_FAILURE_CALCULATION;
     }
+
+    if (!std::isfinite(UELocation.latitude) || !std::isfinite(UELocation.longitude))
+    {
+        std::cerr << "Location could not be calculated from given measurements and configuration.\n";
+        return EXIT_FAILURE_CALCULATION;
+    }
     
-    writeOutputFile( generateGoogleMapsLink(UELocation) );
+    writeOutputFile( generateGoogleMapsLink(UELocation, config.mapsUrlBase), config.outputFile );
 
     return EXIT_SUCCESS;   
 }
+#endif
 
 
 /*
@@ -187,10 +196,11 @@ T_Elipse createElipse(T_MatchedStation station)
  * double antennaHeight Specified in meters.
  * double power Power transmitted in dB (needs to be converted to dBm).
  * double signal Power received in dBm.
+ * const T_Config &config Runtime parameters with precalculated Hata constant.
  *
  * return double Distance to the station in kilometers.
  */
-double calculateDistanceToStation(double antennaHeight, double power, double signal)
+double calculateDistanceToStation(double antennaHeight, double power, double signal, const T_Config &config)
 {
     // Precalculate logarithm to avoid repeated log10 function call
     double log10AntennaHeight = log10(antennaHeight);
@@ -202,7 +212,7 @@ double calculateDistanceToStation(double antennaHeight, double power, double sig
     double pathLoss = (powerTransmitted - signal); 
 
     // Distance calculation
-    double exponent = (double) (-69.55 - (26.16 * log10(FREQUENCE_OF_TRANSMISSION)) + (13.82 * log10AntennaHeight) + ANTENNA_CORRECTION_FACTOR + pathLoss) / (44.9-(6.55*log10AntennaHeight));
+    double exponent = (double) (config.hataConstantTerm + (13.82 * log10AntennaHeight) + pathLoss) / (44.9-(6.55*log10AntennaHeight));
     double distance = pow(10, exponent);
 
     return distance;
@@ -218,10 +228,11 @@ double calculateDistanceToStation(double antennaHeight, double power, double sig
  *
  * std::vector<T_NearestStation> nearbyStation Vector of all nearby stations.
  * std::vector<T_Station> allStations Vector of all station records.
+ * const T_Config &config Runtime parameters used for distance calculation.
  *
  * return std::vector<T_MatchedStation> Vector of all relevant stations.
  */
-std::vector<T_MatchedStation> prepareMatchingStation(std::vector<T_NearestStation> nearbyStations, std::vector<T_Station> allStations)
+std::vector<T_MatchedStation> prepareMatchingStation(std::vector<T_NearestStation> nearbyStations, std::vector<T_Station> allStations, const T_Config &config)
 {
     std::vector<T_MatchedStation> relevantStations;
     
@@ -238,7 +249,7 @@ std::vector<T_MatchedStation> prepareMatchingStation(std::vector<T_NearestStatio
                 newStation.lac = it->lac;
                 newStation.GPS = it->GPS;
                 newStation.GPSCords = convertStringGPS(it->GPS);
-                newStation.distance = calculateDistanceToStation(nsIt->antH, nsIt->power, nsIt->signal);
+                newStation.distance = calculateDistanceToStation(nsIt->antH, nsIt->power, nsIt->signal, config);
 
                 // Store average values for same stations
                 bool skipPushBack = false;
@@ -478,20 +489,273 @@ std::vector<T_NearestStation> loadNearestStations(std::string csvFile)
 /**
  * Processes commandline parameters passed to the application.
  *
+ * The only non-option parameter is the input csv file. Options are collected in
+ * a single pass first, so option values are never mistaken for options, then
+ * applied on top of the configuration file (-c), which is applied on top of 
+ * defaults.
+ *
  * int argc Number of parameters with which the application was called.
  * char** argv Array of parameters provided on input.
+ * T_Config &config Configuration to be filled and finalized.
  *
- * return std::string Input csv file passed from parameters.
+ * return bool True on success, false on invalid or missing parameters.
  */
-std::string processParameters(int argc, char *argv[])
+bool processParameters(int argc, char *argv[], T_Config &config)
 {
+    initConfig(config);
+
+    std::string configFile = EMPTY_STRING;
+    std::string inputFile = EMPTY_STRING;
+    std::vector<std::string> options, keys, values;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string param(argv[i]);
+        std::string key;
+
+        if (param == "-c") key = "config_file";
+        else if (param == "-b") key = "bts_file";
+        else if (param == "-o") key = "output_file";
+        else if (param == "-f") key = "frequency";
+        else if (param == "-u") key = "ue_height";
+        else if (param == "-a") key = "correction_factor";
+        else if (param == "-m") key = "maps_url";
+        else if (param.size() > 1 && param[0] == '-')
+        {
+            std::cerr << "Unknown option " << param << ".\n";
+            return false;
+        }
+        else if (inputFile.compare(EMPTY_STRING) != 0)
+        {
+            std::cerr << "Only one input file can be specified, got " << inputFile << " and " << param << ".\n";
+            return false;
+        }
+        else
+        {
+            inputFile = param;
+            continue;
+        }
+
+        if (i + 1 >= argc)
+        {
+            std::cerr << "Option " << param << " requires a value.\n";
+            return false;
+        }
+
+        if (key == "config_file")
+        {
+            configFile = argv[++i];
+            continue;
+        }
+
+        options.push_back(param);
+        keys.push_back(key);
+        values.push_back(argv[++i]);
+    }
+
+    // Configuration file has to be applied before other options override it
+    if (configFile.compare(EMPTY_STRING) != 0 && !loadConfigFile(configFile, config))
+    {
+        std::cerr << "Configuration file " << configFile << " could not be read.\n";
+        return false;
+    }
+
+    for (size_t i = 0; i < keys.size(); i++)
+    {
+        if (!applyConfigOption(keys.at(i), values.at(i), config))
+        {
+            std::cerr << "Invalid value " << values.at(i) << " for option " << options.at(i) << ".\n";
+            return false;
+        }
+    }
+
     // Terminate execution if no path to input file is provided.
-    if (argc < 2)
+    config.inputFile = inputFile;
+    if (config.inputFile.compare(EMPTY_STRING) == 0)
+    {
+        return false;
+    }
+
+    finalizeConfig(config);
+    return true;
+}
+
+
+/**
+ * Fills configuration with compiled-in default values.
+ *
+ * T_Config &config Configuration to be initialized.
+ */
+void initConfig(T_Config &config)
+{
+    config.inputFile = EMPTY_STRING;
+    config.BTSFile = BTS_INPUT_FILE;
+    config.outputFile = BMS_OUTPUT_FILE;
+    config.mapsUrlBase = GOOGLE_MAPS_URL_BASE;
+    config.transmissionFrequency = FREQUENCE_OF_TRANSMISSION;
+    config.mobileAntennaHeight = USER_EQUIPMENT_HEIGTH;
+    config.antennaCorrectionFactor = ANTENNA_CORRECTION_FACTOR;
+    config.antennaCorrectionFactorSet = false;
+    config.hataConstantTerm = 0;
+}
+
+
+/**
+ * Loads configuration file consisting of 'key = value' lines.
+ *
+ * Empty lines and lines starting with '#' are ignored. Recognized keys are 
+ * the same as accepted by applyConfigOption().
+ *
+ * std::string configFile Path to configuration file.
+ * T_Config &config Configuration to be updated.
+ *
+ * return bool True on success, false when file can not be read or is invalid.
+ */
+bool loadConfigFile(std::string configFile, T_Config &config)
+{
+    std::ifstream file(configFile);
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    const std::string whitespace = " \t\r";
+    std::string lineValue;
+    int lineNumber = 0;
+    while (getline(file, lineValue))
+    {
+        lineNumber++;
+
+        size_t start = lineValue.find_first_not_of(whitespace);
+        if (start == std::string::npos || lineValue[start] == '#')
+        {
+            continue;
+        }
+
+        size_t delimiter = lineValue.find('=');
+        if (delimiter == std::string::npos)
+        {
+            std::cerr << configFile << ":" << lineNumber << ": missing '='.\n";
+            return false;
+        }
+
+        // Trim whitespace around both key and value
+        std::string key = lineValue.substr(start, delimiter - start);
+        key.erase(key.find_last_not_of(whitespace) + 1);
+        std::string value = lineValue.substr(delimiter + 1);
+        size_t valueStart = value.find_first_not_of(whitespace);
+        value = (valueStart == std::string::npos) ? EMPTY_STRING : value.substr(valueStart);
+        value.erase(value.find_last_not_of(whitespace) + 1);
+
+        if (!isConfigOption(key))
+        {
+            std::cerr << configFile << ":" << lineNumber << ": unknown option '" << key << "'.\n";
+            return false;
+        }
+
+        if (!applyConfigOption(key, value, config))
+        {
+            std::cerr << configFile << ":" << lineNumber << ": invalid value '" << value << "' for option '" << key << "'.\n";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/**
+ * Checks whether key names a configuration option.
+ *
+ * std::string key Option name.
+ *
+ * return bool True for keys accepted by applyConfigOption().
+ */
+bool isConfigOption(std::string key)
+{
+    return key == "bts_file" || key == "output_file" || key == "maps_url" 
+        || key == "frequency" || key == "ue_height" || key == "correction_factor";
+}
+
+
+/**
+ * Sets single configuration option.
+ *
+ * Frequency and UE height have to lie within the validity range of the Hata
+ * model, correction factor within +-HATA_MAX_CORRECTION_FACTOR dB.
+ *
+ * std::string key One of bts_file, output_file, maps_url, frequency, 
+ *     ue_height, correction_factor.
+ * std::string value Value to be set, numeric for numeric options.
+ * T_Config &config Configuration to be updated.
+ *
+ * return bool True on success, false on unknown key or invalid value.
+ */
+bool applyConfigOption(std::string key, std::string value, T_Config &config)
+{
+    if (key == "bts_file")
+    {
+        config.BTSFile = value;
+        return !value.empty();
+    }
+    else if (key == "output_file")
+    {
+        config.outputFile = value;
+        return !value.empty();
+    }
+    else if (key == "maps_url")
+    {
+        config.mapsUrlBase = value;
+        return true;
+    }
+
+    char *pEnd;
+    double number = strtod(value.c_str(), &pEnd);
+    if (value.empty() || *pEnd != '\0' || !std::isfinite(number))
+    {
+        return false;
+    }
+
+    if (key == "frequency")
+    {
+        config.transmissionFrequency = number;
+        return number >= HATA_MIN_FREQUENCY && number <= HATA_MAX_FREQUENCY;
+    }
+    else if (key == "ue_height")
+    {
+        config.mobileAntennaHeight = number;
+        return number >= HATA_MIN_UE_HEIGHT && number <= HATA_MAX_UE_HEIGHT;
+    }
+    else if (key == "correction_factor")
+    {
+        config.antennaCorrectionFactor = number;
+        config.antennaCorrectionFactorSet = true;
+        return fabs(number) <= HATA_MAX_CORRECTION_FACTOR;
+    }
+
+    return false;
+}
+
+
+/**
+ * Precalculates values derived from configuration.
+ *
+ * Unless set explicitly, antenna correction factor is recalculated whenever 
+ * frequency or UE height differ from defaults. Frequency dependent part of 
+ * the Hata formula is folded into single constant so the per-station 
+ * distance calculation does not repeat it.
+ *
+ * T_Config &config Configuration to be finalized.
+ */
+void finalizeConfig(T_Config &config)
+{
+    if (!config.antennaCorrectionFactorSet 
+        && (config.transmissionFrequency != FREQUENCE_OF_TRANSMISSION || config.mobileAntennaHeight != USER_EQUIPMENT_HEIGTH))
     {
-        return std::string(EMPTY_STRING);
+        config.antennaCorrectionFactor = helper_calculateAntennaCorrectionFactor(config.transmissionFrequency, config.mobileAntennaHeight);
     }
 
-    return std::string(argv[1]);
+    config.hataConstantTerm = -69.55 - (26.16 * log10(config.transmissionFrequency)) + config.antennaCorrectionFactor;
 }
 
 
@@ -499,12 +763,13 @@ std::string processParameters(int argc, char *argv[])
  * Crafts link to maps.google.com.
  *
  * T_GPS coords Coordinates pointing to location to be marked on map.
+ * std::string mapsUrlBase Base of the link to which coordinates are appended.
  *
  * return std::string Google map link in required format. 
  */
-std::string generateGoogleMapsLink(T_GPS coords)
+std::string generateGoogleMapsLink(T_GPS coords, std::string mapsUrlBase)
 {
-    return GOOGLE_MAPS_URL_BASE + std::to_string(coords.latitude) + "," + std::to_string(coords.longitude);
+    return mapsUrlBase + std::to_string(coords.latitude) + "," + std::to_string(coords.longitude);
 }
 
 
@@ -512,11 +777,12 @@ std::string generateGoogleMapsLink(T_GPS coords)
  * Writes string data to output file.
  *
  * std::string data Data to be written to output file.
+ * std::string outputFile Path to output file.
  */
-void writeOutputFile(std::string data)
+void writeOutputFile(std::string data, std::string outputFile)
 {
     std::ofstream outFile;
-    outFile.open(BMS_OUTPUT_FILE);
+    outFile.open(outputFile);
     outFile << data;
     outFile.close(); 
 }
@@ -528,6 +794,7 @@ void writeOutputFile(std::string data)
  * Based on transmission frequency and mobile antenna height calculates antenna
  * correction factor. This function was used to calculate the AFC at the 
  * beginning and result was used as a constant ANTENNA_CORRECTION_FACTOR. 
+ * Now also used by finalizeConfig() for non-default frequency or UE height.
  *
  * Magical constants used come from the Wikipedia formula, to be found here:
  * https://en.wikipedia.org/wiki/Hata_model
@@ -4,11 +4,20 @@
  * BMS class of 2017/2018, Project #1
  */
 
+// Defaults, overridable by configuration file or commandline options
 #define USER_EQUIPMENT_HEIGTH 1.2
 #define ANTENNA_CORRECTION_FACTOR -0.749018
 #define FREQUENCE_OF_TRANSMISSION 900
 #define GOOGLE_MAPS_URL_BASE "maps.google.com/maps?q="
 #define BMS_OUTPUT_FILE "out.txt"
+#define BTS_INPUT_FILE "bts.csv"
+
+// Validity ranges of the Hata model parameters
+#define HATA_MIN_FREQUENCY 150
+#define HATA_MAX_FREQUENCY 1500
+#define HATA_MIN_UE_HEIGHT 1
+#define HATA_MAX_UE_HEIGHT 10
+#define HATA_MAX_CORRECTION_FACTOR 30
 
 #define EMPTY_STRING ""
 #define EXIT_SUCCESS 0
@@ -24,6 +33,7 @@
 #include <vector>
 #include <algorithm>
 #include <math.h>
+#include <cmath>
 
 
 /**
@@ -102,24 +112,50 @@ typedef struct
 } T_Elipse;
 
 
+/**
+ * Runtime parameters resolved once at startup from defaults, optional 
+ * configuration file and commandline options (in this order of precedence).
+ * Treated as read-only once processParameters() returns.
+ */
+typedef struct
+{
+	std::string inputFile;
+	std::string BTSFile;
+	std::string outputFile;
+	std::string mapsUrlBase;
+	double transmissionFrequency;
+	double mobileAntennaHeight;
+	double antennaCorrectionFactor;
+	bool antennaCorrectionFactorSet;
+
+	// Derived values, precalculated by finalizeConfig()
+	double hataConstantTerm;
+} T_Config;
+
+
 /**
  * Function headers
  */
-std::string processParameters(int argc, char *argv[]);
+bool processParameters(int argc, char *argv[], T_Config &config);
+void initConfig(T_Config &config);
+bool loadConfigFile(std::string configFile, T_Config &config);
+bool applyConfigOption(std::string key, std::string value, T_Config &config);
+bool isConfigOption(std::string key);
+void finalizeConfig(T_Config &config);
 
 std::vector<T_Station> loadBTSRecords(std::string BTSFile);
 std::vector<T_NearestStation> loadNearestStations(std::string csvFile);
-std::vector<T_MatchedStation> prepareMatchingStation(std::vector<T_NearestStation> nearbyStations, std::vector<T_Station> allStations); 
+std::vector<T_MatchedStation> prepareMatchingStation(std::vector<T_NearestStation> nearbyStations, std::vector<T_Station> allStations, const T_Config &config); 
 
 T_GPS convertStringGPS(std::string GPS);
 T_Elipse createElipse(T_MatchedStation station);
 double getDegreesOnly(double degrees, double minutes, double seconds);
-double calculateDistanceToStation(double antennaCorrectionFactor, double transmissionFrequency, double mobileAntenaHeight);
+double calculateDistanceToStation(double antennaHeight, double power, double signal, const T_Config &config);
 T_Point getAverageMidPoint(T_Elipse elipse01, T_Elipse elipse02);
 T_GPS calculateUELocation(std::vector<T_MatchedStation> matchingStations);
 
-void writeOutputFile(std::string data);
-std::string generateGoogleMapsLink(T_GPS coords);
+void writeOutputFile(std::string data, std::string outputFile);
+std::string generateGoogleMapsLink(T_GPS coords, std::string mapsUrlBase);
 
 double helper_calculateAntennaCorrectionFactor(double transmissionFrequency, double mobileAntennaHeight);
 void helper_printElipsePoints(T_Elipse elipse);
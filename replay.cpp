@@ -0,0 +1,779 @@
+/**
+ * Author: Daniel Dusek, xdusek21
+ * Brno, University of Technology
+ * BMS class of 2017/2018, Project #1
+ *
+ * Deterministic replay and differential regression harness. Replays recorded
+ * measurement sets against a catalogue snapshot through two engine
+ * configurations and reports positional deltas, timings and divergences.
+ */
+#include "project.h"
+#include <chrono>
+#include <iomanip>
+#include <thread>
+#include <cstdio>
+#include <cstring>
+#include <climits>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define REPLAY_DEFAULT_ENGINE "reference"
+#define REPLAY_RECORDED_ENGINE "recorded"
+#define REPLAY_DEFAULT_THRESHOLD 1.0
+#define REPLAY_DEFAULT_ITERATIONS 100
+#define REPLAY_MANIFEST_FILE "corpus.txt"
+#define EARTH_RADIUS_METERS 6371000.0
+
+
+/**
+ * Full location pipeline: matches measurements against catalogue and solves.
+ */
+typedef T_GPS (*T_EnginePipeline)(const std::vector<T_NearestStation> &nearbyStations, const std::vector<T_Station> &allStations, const T_Config &config);
+
+
+/**
+ * Engine configuration: pipeline implementation plus its runtime parameters.
+ * Pipeline is NULL for the 'recorded' engine, which yields fixes recorded in
+ * the corpus instead of calculating them.
+ */
+typedef struct
+{
+	std::string spec;
+	T_EnginePipeline pipeline;
+	T_Config config;
+} T_Engine;
+
+
+/**
+ * Single recorded measurement set.
+ */
+typedef struct
+{
+	std::string name;
+	std::vector<T_NearestStation> stations;
+	bool hasExpected;
+	T_GPS expected;
+} T_ReplayCase;
+
+
+/**
+ * Recorded corpus: catalogue snapshot and measurement sets replayed over it.
+ */
+typedef struct
+{
+	std::string cataloguePath;
+	std::vector<std::string> casePaths;
+	std::vector<bool> caseHasExpected;
+	std::vector<T_GPS> caseExpected;
+	std::vector<T_Station> catalogue;
+	std::vector<T_ReplayCase> cases;
+} T_Corpus;
+
+
+/**
+ * Outcome of replaying all cases through one engine.
+ */
+typedef struct
+{
+	std::vector<T_GPS> fixes;
+	std::vector<double> microseconds;
+	std::vector<bool> deterministic;
+} T_EngineRun;
+
+
+/**
+ * Function headers
+ */
+T_GPS engine_reference(const std::vector<T_NearestStation> &nearbyStations, const std::vector<T_Station> &allStations, const T_Config &config);
+bool parseEngineSpec(std::string spec, T_Engine &engine);
+bool loadCorpus(std::string manifestFile, T_Corpus &corpus);
+bool recordCorpus(const T_Corpus &corpus, std::string outputDir);
+void replayEngine(const T_Engine &engine, const T_Corpus &corpus, int iterations, T_EngineRun &run);
+double timeEngineCase(const T_Engine &engine, const T_ReplayCase &replayCase, const std::vector<T_Station> &catalogue, int iterations);
+double getDistanceMeters(T_GPS a, T_GPS b);
+bool isFailedFix(T_GPS fix);
+bool isValidFix(T_GPS fix);
+bool isSameFix(T_GPS a, T_GPS b);
+bool hasAllExpected(const T_Corpus &corpus);
+std::string getDirectory(std::string path);
+std::string getFileName(std::string path);
+int runReplay(int argc, char *argv[]);
+int runRecord(int argc, char *argv[]);
+void printUsage();
+
+
+int main(int argc, char *argv[])
+{
+    if (argc >= 2 && std::string(argv[1]) == "run")
+    {
+        return runReplay(argc, argv);
+    }
+    else if (argc >= 2 && std::string(argv[1]) == "record")
+    {
+        return runRecord(argc, argv);
+    }
+
+    printUsage();
+    return EXIT_FAILURE_PARAMS;
+}
+
+
+/**
+ * Replays corpus through two engines in parallel and compares their fixes,
+ * then times each engine separately.
+ *
+ * int argc Number of parameters with which the application was called.
+ * char** argv Array of parameters provided on input.
+ *
+ * return int EXIT_SUCCESS when engines agree within threshold,
+ *     EXIT_FAILURE_CALCULATION on divergence, other EXIT_FAILURE_* on error.
+ */
+int runReplay(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        printUsage();
+        return EXIT_FAILURE_PARAMS;
+    }
+
+    std::string specA = EMPTY_STRING, specB = REPLAY_DEFAULT_ENGINE;
+    double threshold = REPLAY_DEFAULT_THRESHOLD;
+    int iterations = REPLAY_DEFAULT_ITERATIONS;
+
+    for (int i = 3; i < argc; i++)
+    {
+        std::string param(argv[i]);
+        if (i + 1 >= argc)
+        {
+            std::cerr << "Option " << param << " requires a value.\n";
+            return EXIT_FAILURE_PARAMS;
+        }
+
+        char *pEnd;
+        std::string value(argv[++i]);
+        if (param == "-a") specA = value;
+        else if (param == "-b") specB = value;
+        else if (param == "-t")
+        {
+            threshold = strtod(value.c_str(), &pEnd);
+            if (value.empty() || *pEnd != '\0' || !std::isfinite(threshold))
+            {
+                threshold = -1;
+            }
+        }
+        else if (param == "-n")
+        {
+            long number = strtol(value.c_str(), &pEnd, 10);
+            iterations = (value.empty() || *pEnd != '\0' || number > INT_MAX) ? 0 : (int) number;
+        }
+        else
+        {
+            std::cerr << "Unknown option " << param << ".\n";
+            return EXIT_FAILURE_PARAMS;
+        }
+    }
+
+    if (threshold < 0 || iterations < 1)
+    {
+        std::cerr << "Threshold must not be negative and iterations must be positive.\n";
+        return EXIT_FAILURE_PARAMS;
+    }
+
+    T_Corpus corpus;
+    if (!loadCorpus(argv[2], corpus))
+    {
+        return EXIT_FAILURE_INPUTFILE;
+    }
+
+    // Compare against recorded fixes by default, when corpus pins them
+    if (specA.compare(EMPTY_STRING) == 0)
+    {
+        specA = hasAllExpected(corpus) ? REPLAY_RECORDED_ENGINE : REPLAY_DEFAULT_ENGINE;
+    }
+
+    T_Engine engineA, engineB;
+    if (!parseEngineSpec(specA, engineA) || !parseEngineSpec(specB, engineB))
+    {
+        return EXIT_FAILURE_PARAMS;
+    }
+
+    if ((engineA.pipeline == NULL || engineB.pipeline == NULL) && !hasAllExpected(corpus))
+    {
+        std::cerr << "Engine " << REPLAY_RECORDED_ENGINE << " requires expected fix for every case in " << argv[2] << ".\n";
+        return EXIT_FAILURE_PARAMS;
+    }
+
+    // Both engines replay the very same immutable corpus, one thread each
+    T_EngineRun runA, runB;
+    std::thread threadA(replayEngine, std::cref(engineA), std::cref(corpus), iterations, std::ref(runA));
+    std::thread threadB(replayEngine, std::cref(engineB), std::cref(corpus), iterations, std::ref(runB));
+    threadA.join();
+    threadB.join();
+
+    // Timing runs one engine after the other, so they do not compete for CPU,
+    // recorded fixes are not timed (negative duration)
+    // alternating per case so neither engine benefits from running later
+    for (std::vector<T_ReplayCase>::const_iterator it = corpus.cases.begin(); it != corpus.cases.end(); ++it)
+    {
+        runA.microseconds.push_back(timeEngineCase(engineA, *it, corpus.catalogue, iterations));
+        runB.microseconds.push_back(timeEngineCase(engineB, *it, corpus.catalogue, iterations));
+    }
+
+    std::cout << "A: " << engineA.spec << "\nB: " << engineB.spec << "\n";
+    std::cout << "Threshold: " << threshold << " m, iterations: " << iterations 
+        << " (timed sequentially after 1 warm-up run per case)\n\n";
+    std::cout << std::left << std::setw(16) << "case"
+        << std::setw(24) << "A lat,lon" << std::setw(24) << "B lat,lon"
+        << std::right << std::setw(12) << "delta[m]" << std::setw(10) << "A[us]"
+        << std::setw(10) << "B[us]" << std::setw(9) << "speedup" << "  status\n";
+
+    int divergences = 0;
+    double totalA = 0, totalB = 0, maxDelta = 0;
+    for (size_t i = 0; i < corpus.cases.size(); i++)
+    {
+        T_GPS fixA = runA.fixes.at(i);
+        T_GPS fixB = runB.fixes.at(i);
+        bool failedA = isFailedFix(fixA);
+        bool failedB = isFailedFix(fixB);
+
+        bool invalid = !isValidFix(fixA) || !isValidFix(fixB);
+
+        // Both engines refusing to locate UE counts as agreement
+        double delta = (failedA || failedB || invalid) ? 0 : getDistanceMeters(fixA, fixB);
+        bool unstable = !runA.deterministic.at(i) || !runB.deterministic.at(i);
+        bool diverged = (failedA != failedB) || delta > threshold || unstable || invalid;
+        if (diverged)
+        {
+            divergences++;
+        }
+        if (delta > maxDelta)
+        {
+            maxDelta = delta;
+        }
+
+        double timeA = runA.microseconds.at(i);
+        double timeB = runB.microseconds.at(i);
+        totalA += timeA;
+        totalB += timeB;
+
+        std::ostringstream coordsA, coordsB, timingA, timingB, speedup;
+        coordsA << std::fixed << std::setprecision(6) << fixA.latitude << "," << fixA.longitude;
+        coordsB << std::fixed << std::setprecision(6) << fixB.latitude << "," << fixB.longitude;
+        timingA << std::fixed << std::setprecision(3) << timeA;
+        timingB << std::fixed << std::setprecision(3) << timeB;
+        speedup << std::fixed << std::setprecision(2) << (timeA / timeB) << "x";
+
+        std::cout << std::left << std::setw(16) << corpus.cases.at(i).name
+            << std::setw(24) << (failedA ? "-" : coordsA.str()) << std::setw(24) << (failedB ? "-" : coordsB.str())
+            << std::right << std::fixed << std::setprecision(3) << std::setw(12) << delta
+            << std::setw(10) << (timeA < 0 ? "-" : timingA.str()) << std::setw(10) << (timeB < 0 ? "-" : timingB.str())
+            << std::setw(9) << (timeA < 0 || timeB < 0 ? "-" : speedup.str())
+            << "  " << (unstable ? "UNSTABLE" : (invalid ? "INVALID" : (diverged ? "DIVERGED" : "ok"))) << "\n";
+    }
+
+    std::cout << "\nCases: " << corpus.cases.size() << ", divergences: " << divergences
+        << ", max delta: " << std::setprecision(3) << maxDelta << " m";
+    if (totalA >= 0 && totalB >= 0)
+    {
+        std::cout << ", total speedup B over A: " << std::setprecision(2) << (totalA / totalB) << "x";
+    }
+    std::cout << "\n";
+
+    return divergences == 0 ? EXIT_SUCCESS : EXIT_FAILURE_CALCULATION;
+}
+
+
+/**
+ * Records snapshot of a corpus so it stays replayable after sources change.
+ *
+ * Copies catalogue and all measurement sets into output directory, which must
+ * not exist or be empty, and writes manifest referencing the copies. Expected
+ * fixes already pinned by the corpus are kept, missing ones are calculated by
+ * the reference engine with default configuration.
+ *
+ * int argc Number of parameters with which the application was called.
+ * char** argv Array of parameters provided on input.
+ *
+ * return int EXIT_SUCCESS on success, EXIT_FAILURE_* otherwise.
+ */
+int runRecord(int argc, char *argv[])
+{
+    if (argc != 4)
+    {
+        printUsage();
+        return EXIT_FAILURE_PARAMS;
+    }
+
+    T_Corpus corpus;
+    if (!loadCorpus(argv[2], corpus))
+    {
+        return EXIT_FAILURE_INPUTFILE;
+    }
+
+    if (!recordCorpus(corpus, argv[3]))
+    {
+        std::cerr << "Corpus snapshot could not be written to " << argv[3] << ".\n";
+        return EXIT_FAILURE_INPUTFILE;
+    }
+
+    std::cout << "Recorded catalogue and " << corpus.cases.size() << " cases to " << argv[3] << ".\n";
+    return EXIT_SUCCESS;
+}
+
+
+/**
+ * Reference engine, the original location pipeline of p1.
+ *
+ * const std::vector<T_NearestStation> &nearbyStations Measurement set.
+ * const std::vector<T_Station> &allStations Catalogue of all stations.
+ * const T_Config &config Runtime parameters.
+ *
+ * return T_GPS Location of User equipment on success, -1,-1 on failure.
+ */
+T_GPS engine_reference(const std::vector<T_NearestStation> &nearbyStations, const std::vector<T_Station> &allStations, const T_Config &config)
+{
+    return calculateUELocation(prepareMatchingStation(nearbyStations, allStations, config));
+}
+
+
+/**
+ * Resolves engine specification in 'name' or 'name:configFile' format.
+ *
+ * New engines are registered here by name. Engine 'recorded' yields expected
+ * fixes pinned in the corpus and takes no configuration.
+ *
+ * std::string spec Engine specification.
+ * T_Engine &engine Engine to be filled.
+ *
+ * return bool True on success, false on unknown engine or invalid config.
+ */
+bool parseEngineSpec(std::string spec, T_Engine &engine)
+{
+    size_t delimiter = spec.find(':');
+    std::string name = spec.substr(0, delimiter);
+
+    engine.spec = spec;
+    initConfig(engine.config);
+    if (delimiter != std::string::npos && !loadConfigFile(spec.substr(delimiter + 1), engine.config))
+    {
+        std::cerr << "Configuration file for engine " << spec << " could not be read.\n";
+        return false;
+    }
+    finalizeConfig(engine.config);
+
+    if (name == "reference")
+    {
+        engine.pipeline = engine_reference;
+        return true;
+    }
+    else if (name == REPLAY_RECORDED_ENGINE && delimiter == std::string::npos)
+    {
+        engine.pipeline = NULL;
+        return true;
+    }
+
+    std::cerr << "Unknown engine " << name << ".\n";
+    return false;
+}
+
+
+/**
+ * Loads corpus manifest together with all files it references.
+ *
+ * Manifest consists of 'catalogue <path>' line and 'case <path>' lines, relative
+ * paths being resolved against the manifest. Each case may be followed by 
+ * 'expect <latitude> <longitude>' line pinning its fix (-1 -1 when location 
+ * can not be determined). Empty lines and '#' comments are ignored.
+ *
+ * std::string manifestFile Path to the manifest.
+ * T_Corpus &corpus Corpus to be filled.
+ *
+ * return bool True on success, false when any of the files is unusable.
+ */
+bool loadCorpus(std::string manifestFile, T_Corpus &corpus)
+{
+    std::ifstream file(manifestFile);
+    if (!file.is_open())
+    {
+        std::cerr << "Corpus manifest " << manifestFile << " could not be opened.\n";
+        return false;
+    }
+
+    std::string lineValue;
+    while (getline(file, lineValue))
+    {
+        std::istringstream iss(lineValue);
+        std::string kind, path, longitude;
+        iss >> kind >> path >> longitude;
+
+        // Relative paths are resolved against the manifest location
+        std::string resolvedPath = (!path.empty() && path[0] == '/') ? path : getDirectory(manifestFile) + path;
+
+        if (kind.empty() || kind[0] == '#')
+        {
+            continue;
+        }
+
+        if (kind == "catalogue")
+        {
+            corpus.cataloguePath = resolvedPath;
+        }
+        else if (kind == "case")
+        {
+            corpus.casePaths.push_back(resolvedPath);
+            corpus.caseHasExpected.push_back(false);
+            corpus.caseExpected.push_back(T_GPS());
+        }
+        else if (kind == "expect")
+        {
+            char *pEndLat, *pEndLon;
+            T_GPS expected;
+            expected.latitude = strtod(path.c_str(), &pEndLat);
+            expected.longitude = strtod(longitude.c_str(), &pEndLon);
+
+            if (corpus.casePaths.empty() || corpus.caseHasExpected.back() || path.empty() || longitude.empty() 
+                || *pEndLat != '\0' || *pEndLon != '\0' || !isValidFix(expected))
+            {
+                std::cerr << "Invalid expect entry '" << lineValue << "' in " << manifestFile << ".\n";
+                return false;
+            }
+
+            corpus.caseHasExpected.back() = true;
+            corpus.caseExpected.back() = expected;
+        }
+        else
+        {
+            std::cerr << "Unknown corpus entry " << kind << " in " << manifestFile << ".\n";
+            return false;
+        }
+    }
+
+    corpus.catalogue = loadBTSRecords(corpus.cataloguePath);
+    if (corpus.catalogue.empty())
+    {
+        std::cerr << "Catalogue " << corpus.cataloguePath << " could not be loaded.\n";
+        return false;
+    }
+
+    for (size_t i = 0; i < corpus.casePaths.size(); i++)
+    {
+        T_ReplayCase replayCase;
+        replayCase.name = getFileName(corpus.casePaths.at(i));
+        replayCase.stations = loadNearestStations(corpus.casePaths.at(i));
+        replayCase.hasExpected = corpus.caseHasExpected.at(i);
+        replayCase.expected = corpus.caseExpected.at(i);
+        if (replayCase.stations.empty())
+        {
+            std::cerr << "Measurement set " << corpus.casePaths.at(i) << " could not be loaded.\n";
+            return false;
+        }
+        corpus.cases.push_back(replayCase);
+    }
+
+    return true;
+}
+
+
+/**
+ * Copies corpus files byte for byte into a new snapshot directory.
+ *
+ * Files are written into a temporary sibling directory first, which is moved
+ * into place only after every copy and the manifest succeeded. Sources are
+ * therefore never opened for writing and a failed record leaves nothing 
+ * behind. Output directory must not exist, or be empty.
+ *
+ * const T_Corpus &corpus Loaded corpus.
+ * std::string outputDir Directory for the snapshot.
+ *
+ * return bool True on success, false on any I/O failure.
+ */
+bool recordCorpus(const T_Corpus &corpus, std::string outputDir)
+{
+    while (outputDir.size() > 1 && outputDir[outputDir.size() - 1] == '/')
+    {
+        outputDir.erase(outputDir.size() - 1);
+    }
+
+    struct stat info;
+    if (stat((outputDir + "/" + REPLAY_MANIFEST_FILE).c_str(), &info) == 0)
+    {
+        std::cerr << "Refusing to overwrite existing corpus in " << outputDir << ".\n";
+        return false;
+    }
+
+    std::string tempTemplate = outputDir + ".tmp-XXXXXX";
+    std::vector<char> tempBuffer(tempTemplate.begin(), tempTemplate.end());
+    tempBuffer.push_back('\0');
+    if (mkdtemp(tempBuffer.data()) == NULL)
+    {
+        return false;
+    }
+    std::string tempDir = std::string(tempBuffer.data()) + "/";
+
+    // mkdtemp creates the directory accessible by owner only, use umask instead
+    mode_t mask = umask(0);
+    umask(mask);
+    bool success = chmod(tempBuffer.data(), 0777 & ~mask) == 0;
+
+    T_Engine reference;
+    parseEngineSpec(REPLAY_DEFAULT_ENGINE, reference);
+
+    std::vector<std::string> sources(1, corpus.cataloguePath);
+    std::vector<std::string> targets(1, "catalogue.csv");
+    for (size_t i = 0; i < corpus.casePaths.size(); i++)
+    {
+        sources.push_back(corpus.casePaths.at(i));
+        targets.push_back("case" + std::to_string(i + 1) + "-" + getFileName(corpus.casePaths.at(i)));
+    }
+
+    std::vector<std::string> written;
+    std::ostringstream manifest;
+    manifest << std::setprecision(17) << "# Recorded corpus snapshot\n";
+
+    for (size_t i = 0; i < sources.size() && success; i++)
+    {
+        std::ifstream source(sources.at(i), std::ios::binary);
+        std::ofstream target(tempDir + targets.at(i), std::ios::binary);
+        written.push_back(tempDir + targets.at(i));
+        target << source.rdbuf();
+        target.close();
+        success = source.is_open() && !target.fail();
+
+        manifest << (i == 0 ? "catalogue " : "case ") << targets.at(i) << "\n";
+        if (i == 0)
+        {
+            continue;
+        }
+
+        // Pin fix of the case, so later runs can be compared against it
+        const T_ReplayCase &replayCase = corpus.cases.at(i - 1);
+        T_GPS expected = replayCase.hasExpected ? replayCase.expected 
+            : reference.pipeline(replayCase.stations, corpus.catalogue, reference.config);
+        if (!isValidFix(expected))
+        {
+            std::cerr << "Reference engine produced invalid fix for " << replayCase.name << ".\n";
+            success = false;
+        }
+        manifest << "expect " << expected.latitude << " " << expected.longitude << "\n";
+    }
+
+    // Manifest is written last, so it only ever references complete copies
+    if (success)
+    {
+        std::ofstream manifestFile(tempDir + REPLAY_MANIFEST_FILE);
+        written.push_back(tempDir + REPLAY_MANIFEST_FILE);
+        manifestFile << manifest.str();
+        manifestFile.close();
+        success = !manifestFile.fail();
+    }
+
+    // Replaces output directory only when it does not exist or is empty
+    if (success && rename(tempBuffer.data(), outputDir.c_str()) == 0)
+    {
+        return true;
+    }
+
+    for (std::vector<std::string>::iterator it = written.begin(); it != written.end(); ++it)
+    {
+        remove(it->c_str());
+    }
+    rmdir(tempBuffer.data());
+
+    return false;
+}
+
+
+/**
+ * Replays all corpus cases through the engine to collect fixes.
+ *
+ * Each case is solved the given number of times and fix of the first run is
+ * kept, recorded engine yields expected fixes. Repeated runs have to 
+ * reproduce the first fix bit for bit, otherwise
+ * case is marked as non-deterministic. Safe to run for both engines in 
+ * parallel, as nothing is timed here.
+ *
+ * const T_Engine &engine Engine to be used.
+ * const T_Corpus &corpus Corpus to be replayed.
+ * int iterations Number of repetitions per case.
+ * T_EngineRun &run Collected fixes.
+ */
+void replayEngine(const T_Engine &engine, const T_Corpus &corpus, int iterations, T_EngineRun &run)
+{
+    for (std::vector<T_ReplayCase>::const_iterator it = corpus.cases.begin(); it != corpus.cases.end(); ++it)
+    {
+        if (engine.pipeline == NULL)
+        {
+            run.fixes.push_back(it->expected);
+            run.deterministic.push_back(true);
+            continue;
+        }
+
+        T_GPS fix = engine.pipeline(it->stations, corpus.catalogue, engine.config);
+        bool deterministic = true;
+
+        for (int i = 0; i < iterations; i++)
+        {
+            T_GPS repeated = engine.pipeline(it->stations, corpus.catalogue, engine.config);
+            deterministic &= isSameFix(repeated, fix);
+        }
+
+        run.fixes.push_back(fix);
+        run.deterministic.push_back(deterministic);
+    }
+}
+
+
+/**
+ * Measures mean duration of a single engine run on one corpus case.
+ *
+ * Has to be called while no other engine is running, so the engines are not
+ * competing for CPU. Case gets one untimed warm-up run first.
+ *
+ * const T_Engine &engine Engine to be used.
+ * const T_ReplayCase &replayCase Measurement set to be solved.
+ * const std::vector<T_Station> &catalogue Catalogue of all stations.
+ * int iterations Number of timed repetitions.
+ *
+ * return double Mean duration of one run in microseconds, -1 for recorded 
+ *     engine.
+ */
+double timeEngineCase(const T_Engine &engine, const T_ReplayCase &replayCase, const std::vector<T_Station> &catalogue, int iterations)
+{
+    if (engine.pipeline == NULL)
+    {
+        return -1;
+    }
+
+    // Results are accumulated so the calls can not be optimized out
+    volatile double sink = 0;
+    sink = sink + engine.pipeline(replayCase.stations, catalogue, engine.config).latitude;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+    {
+        sink = sink + engine.pipeline(replayCase.stations, catalogue, engine.config).latitude;
+    }
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+
+    return elapsed.count() / iterations;
+}
+
+
+/**
+ * Calculates great-circle distance between two fixes (haversine formula).
+ *
+ * T_GPS a First location.
+ * T_GPS b Second location.
+ *
+ * return double Distance in meters.
+ */
+double getDistanceMeters(T_GPS a, T_GPS b)
+{
+    double dLat = (b.latitude - a.latitude) * M_PI / 180.0;
+    double dLon = (b.longitude - a.longitude) * M_PI / 180.0;
+    double h = sin(dLat / 2) * sin(dLat / 2)
+        + cos(a.latitude * M_PI / 180.0) * cos(b.latitude * M_PI / 180.0) * sin(dLon / 2) * sin(dLon / 2);
+
+    return 2 * EARTH_RADIUS_METERS * asin(sqrt(h));
+}
+
+
+/**
+ * Checks for false-y value returned by calculateUELocation().
+ *
+ * T_GPS fix Location to be checked.
+ *
+ * return bool True when location could not be determined.
+ */
+bool isFailedFix(T_GPS fix)
+{
+    return fix.latitude <= -1 && fix.longitude <= -1;
+}
+
+
+/**
+ * Checks that both coordinates of the fix are finite numbers.
+ *
+ * T_GPS fix Location to be checked.
+ *
+ * return bool True when fix is usable.
+ */
+bool isValidFix(T_GPS fix)
+{
+    return std::isfinite(fix.latitude) && std::isfinite(fix.longitude);
+}
+
+
+/**
+ * Compares fixes bit for bit, so repeated NaN fixes are considered same.
+ *
+ * T_GPS a First location.
+ * T_GPS b Second location.
+ *
+ * return bool True when fixes are identical.
+ */
+bool isSameFix(T_GPS a, T_GPS b)
+{
+    return memcmp(&a.latitude, &b.latitude, sizeof(double)) == 0 
+        && memcmp(&a.longitude, &b.longitude, sizeof(double)) == 0;
+}
+
+
+/**
+ * Checks whether every corpus case has expected fix recorded.
+ *
+ * const T_Corpus &corpus Loaded corpus.
+ *
+ * return bool True when recorded engine can be used.
+ */
+bool hasAllExpected(const T_Corpus &corpus)
+{
+    for (std::vector<T_ReplayCase>::const_iterator it = corpus.cases.begin(); it != corpus.cases.end(); ++it)
+    {
+        if (!it->hasExpected)
+        {
+            return false;
+        }
+    }
+
+    return !corpus.cases.empty();
+}
+
+
+/**
+ * Extracts directory part of the path, including trailing slash.
+ *
+ * std::string path File path.
+ *
+ * return std::string Directory or empty string for bare file names.
+ */
+std::string getDirectory(std::string path)
+{
+    size_t slash = path.find_last_of('/');
+    return (slash == std::string::npos) ? EMPTY_STRING : path.substr(0, slash + 1);
+}
+
+
+/**
+ * Extracts file name part of the path.
+ *
+ * std::string path File path.
+ *
+ * return std::string File name.
+ */
+std::string getFileName(std::string path)
+{
+    size_t slash = path.find_last_of('/');
+    return (slash == std::string::npos) ? path : path.substr(slash + 1);
+}
+
+
+/**
+ * Prints out usage of the harness.
+ */
+void printUsage()
+{
+    std::cerr << "Usage: p1-replay run <corpus.txt> [-a engine[:config]] [-b engine[:config]] [-t thresholdMeters] [-n iterations]\n";
+    std::cerr << "       p1-replay record <corpus.txt> <outputDir>\n";
+    std::cerr << "Engines: reference, recorded (fixes pinned in corpus, default for -a when available)\n";
+}